@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+// Author: Dat Nguyen
+// memview.c reads a snapshot file written by oss -m and rebuilds the memory layout (frame table and page tables) at any simulated time.
+
+void help();
+
+int main(int argc, char **argv) {
+	int userInput = 0;
+	char *snapFileName = NULL;
+	int listRecords = 0;
+	int haveTime = 0;
+	unsigned int targetSec = 0;
+	unsigned int targetNano = 0;
+
+	while ((userInput = getopt(argc, argv, "f:t:lh")) != -1) {
+		switch(userInput) {
+			case 'f': // Snapshot file to read
+				snapFileName = optarg;
+				break;
+			case 't': // Simulated time to rebuild, sec or sec:nano
+				if (sscanf(optarg, "%u:%u", &targetSec, &targetNano) < 1) {
+					printf("Error: time must be given as sec or sec:nano. \n");
+					exit(1);
+				}
+				haveTime = 1;
+				break;
+			case 'l': // List records instead of rebuilding
+				listRecords = 1;
+				break;
+			case 'h': // Prints out help function.
+				help();
+				return 0;
+			case '?': // Invalid user argument handling.
+				printf("Error: Invalid argument detected \n");
+				printf("Usage: ./memview -h to learn how to use this program \n");
+				exit(1);
+		}
+	}
+
+	if (snapFileName == NULL) {
+		printf("Error: a snapshot file must be given with -f. \n");
+		exit(1);
+	}
+
+	int fd = open(snapFileName, O_RDONLY);
+	if (fd == -1) {
+		printf("Error: failed opening snapshot file. \n");
+		exit(1);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+		printf("Error: snapshot file is too small. \n");
+		exit(1);
+	}
+
+	char *map = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("Error: failed mapping snapshot file. \n");
+		exit(1);
+	}
+
+	const SnapshotHeader *header = (const SnapshotHeader *)map;
+	if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->frameCount != FRAME_COUNT || header->maxPcb != MAX_PCB || header->numPages != NUM_PAGES) {
+		printf("Error: snapshot file was not written by this version of oss. \n");
+		exit(1);
+	}
+
+	// Only trust records the writer finished, a crashed run may leave a zeroed tail.
+	size_t end = sizeof(SnapshotHeader) + header->length;
+	if (end > (size_t)st.st_size) {
+		end = st.st_size;
+	}
+
+	FrameTableEntry frameTable[FRAME_COUNT];
+	SnapshotPCB pcbTable[MAX_PCB];
+	memset(frameTable, 0, sizeof(frameTable));
+	memset(pcbTable, 0, sizeof(pcbTable));
+
+	int applied = 0;
+	unsigned int shownSec = 0, shownNano = 0;
+	size_t offset = sizeof(SnapshotHeader);
+
+	while (offset + sizeof(SnapshotRecord) <= end) {
+		const SnapshotRecord *record = (const SnapshotRecord *)(map + offset);
+		size_t recordSize = sizeof(SnapshotRecord) + record->frameChanges * sizeof(SnapshotFrame) + record->pcbChanges * sizeof(SnapshotPCB);
+		if (record->frameChanges > FRAME_COUNT || record->pcbChanges > MAX_PCB || offset + recordSize > end) {
+			printf("Error: truncated record at offset %zu. \n", offset);
+			break;
+		}
+
+		if (listRecords) {
+			printf("%s at %u:%u: %u frames, %u PCBs\n", record->type == SNAPSHOT_KEYFRAME ? "Keyframe" : "Delta", record->seconds, record->nanoseconds, record->frameChanges, record->pcbChanges);
+			offset += recordSize;
+			continue;
+		}
+
+		if (haveTime && (record->seconds > targetSec || (record->seconds == targetSec && record->nanoseconds > targetNano))) {
+			break; // Past the requested time
+		}
+
+		if (!applied && record->type != SNAPSHOT_KEYFRAME) {
+			printf("Error: snapshot file does not start with a keyframe. \n");
+			exit(1);
+		}
+
+		// Apply changed frames and PCBs, keyframes overwrite everything
+		const SnapshotFrame *frames = (const SnapshotFrame *)(map + offset + sizeof(SnapshotRecord));
+		for (unsigned int i = 0; i < record->frameChanges; i++) {
+			if (frames[i].frameIndex >= 0 && frames[i].frameIndex < FRAME_COUNT) {
+				frameTable[frames[i].frameIndex] = frames[i].entry;
+			}
+		}
+
+		const SnapshotPCB *pcbs = (const SnapshotPCB *)(frames + record->frameChanges);
+		for (unsigned int i = 0; i < record->pcbChanges; i++) {
+			if (pcbs[i].pcbIndex >= 0 && pcbs[i].pcbIndex < MAX_PCB) {
+				pcbTable[pcbs[i].pcbIndex] = pcbs[i];
+			}
+		}
+
+		shownSec = record->seconds;
+		shownNano = record->nanoseconds;
+		applied++;
+		offset += recordSize;
+	}
+
+	if (!listRecords) {
+		if (!applied) {
+			printf("No snapshot at or before the requested time. \n");
+		}
+		else {
+			// Same layout oss prints without -m
+			printf("Memory Layout at %u:%u\n", shownSec, shownNano);
+			for (int i = 0; i < FRAME_COUNT; i++) {
+				printf("Frame %d: %s Dirty=%d Order=%d LastRef=%u:%u\n", i, frameTable[i].occupied ? "Occupied" : "Empty", frameTable[i].dirty, frameTable[i].pageOrder, frameTable[i].lastRefSec, frameTable[i].lastRefNano);
+			}
+
+			for (int i = 0; i < MAX_PCB; i++) { // Rebuild each page table from the frames that point back at it
+				if (pcbTable[i].occupied) {
+					int pageTable[NUM_PAGES];
+					for (int j = 0; j < NUM_PAGES; j++) {
+						pageTable[j] = -1;
+					}
+					for (int f = 0; f < FRAME_COUNT; f++) {
+						if (frameTable[f].occupied && frameTable[f].processIndex == i && frameTable[f].pageNumber >= 0 && frameTable[f].pageNumber < NUM_PAGES) {
+							pageTable[frameTable[f].pageNumber] = f;
+						}
+					}
+
+					printf("P%d Page Table: [", pcbTable[i].pid);
+					for (int j = 0; j < NUM_PAGES; j++) {
+						printf("%d ", pageTable[j]);
+					}
+					printf("]\n");
+				}
+			}
+		}
+	}
+
+	munmap(map, st.st_size);
+	close(fd);
+	return 0;
+}
+
+void help() {
+	printf("Usage: ./memview -f snapfile [-t sec[:nano]] [-l] [-h]\n");
+	printf("Options:\n");
+	printf("-h            Show this help message and exit.\n");
+	printf("-f snapfile   Snapshot file written by ./oss -m.\n");
+	printf("-t sec[:nano] Rebuild the memory layout as of this simulated time (default: end of run).\n");
+	printf("-l            List every record in the file instead of rebuilding.\n");
+}
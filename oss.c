@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h> // For flock
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/msg.h>
@@ -10,12 +13,15 @@
 #include <time.h>
 #include <string.h> // For memset
 #include "oss.h"
+#include "snapshot.h"
 
 // Author: Dat Nguyen
 // Date: 05/17/2025
 // oss.c is the main function that simulates loading pages, simulates queue system, and handles any page faults or hits.
 
 #define NANO_TO_SEC 1000000000
+#define BUDDY_TOP_ORDER 8 // FRAME_COUNT is 2^8 frames
+#define DRAIN_TIMEOUT_MS 500 // How long workers get to exit after SIGTERM before SIGKILL
 
 // I/O queue as parallel arrays
 int ioQueue_pcbIndex[FRAME_COUNT]; // index of PCB table
@@ -32,13 +38,39 @@ int ioQueueHead = 0;
 int ioQueueTail = 0;
 int ioQueueCount = 0;
 int blocked[MAX_PCB] = {0};  // 1 if process is blocked on I/O
+volatile sig_atomic_t shutdownSignal = 0; // Set by signalHandler, main loop tears down when non-zero
+
+// Buddy allocator over the frame table, freeBlockOrder[f] is the order of the free block starting at frame f or -1
+int freeBlockOrder[FRAME_COUNT];
+int hugeOrder = DEFAULT_HUGE_ORDER; // Huge page is 2^hugeOrder frames
+int hugePercent = 0; // Chance each region of a new process is mapped with huge pages
+
+// Huge page statistics
+unsigned long long hugeFaults = 0; // Faults that loaded a whole huge page
+unsigned long long hugeFallbacks = 0; // Huge faults served with a base page because no block was free
+unsigned long long hugeFramesLoaded = 0; // Frames brought in by huge faults
+unsigned long long hugeFramesUntouched = 0; // Of those, frames released or split without ever being accessed
+unsigned long long hugeEvictions = 0; // Huge pages evicted as a unit
+unsigned long long hugeSplits = 0; // Huge pages split into base pages to evict one frame
+int residentFrames = 0; // Occupied frames right now
+int mappingUnits = 0; // Mappings covering them, a huge page counts once. This is the TLB entries they need
 
 void incrementClock(SimulatedClock *clock, int addSec, int addNano); // Clock increment
+int buddyAlloc(int order);
+void buddyFree(int frame, int order);
+int faultOrder(int pcbIndex, int page);
+int allocFrames(int *order);
+void loadPage(int pcbIndex, int page, int order, int frame, int isWrite, SimulatedClock *clock, FILE *file);
+void releaseUnit(int frame);
+void evictLRU(int order, FILE *file);
+int sweepStaleIPC();
+int teardownWorkers(pid_t workerGroup);
 void signalHandler(int sig);
 void help();
 
 PCB processTable[MAX_PCB]; // Process Table
 FrameTableEntry frameTable[FRAME_COUNT]; // Frame Table
+SnapshotWriter snapshot; // Memory map snapshot file, used with -m
 
 int main(int argc, char **argv) {
 	int userInput = 0;
@@ -48,12 +80,18 @@ int main(int argc, char **argv) {
 	int launched = 0;
 	int activeProcesses = 0;
 	int nextLaunchTime = 0;
+	pid_t workerGroup = 0; // Process group every worker joins, so teardown can signal them all at once
 	time_t startTime = time(NULL);
 	char *logFileName = "oss.log";
+	char *snapFileName = NULL;
+	int snapshotEnabled = 0;
 	unsigned long long totalAccesses = 0;
 	unsigned long long totalPageFaults = 0;
+	unsigned long long residentFramesSum = 0; // residentFrames sampled on every page fault
+	unsigned long long mappingUnitsSum = 0; // mappingUnits sampled on every page fault
+	unsigned long long residentSamples = 0;
 
-	while ((userInput = getopt(argc, argv, "n:s:i:f:hv")) != -1) {
+	while ((userInput = getopt(argc, argv, "n:s:i:f:m:H:z:hv")) != -1) {
 		switch(userInput) {
 			case 'n': // How many child processes to launch.
 				totalProcesses = atoi(optarg);
@@ -85,6 +123,23 @@ int main(int argc, char **argv) {
 			case 'f': // Input name of log file
 				logFileName = optarg;
                                 break;
+			case 'm': // Write memory map snapshots to this file instead of printing them
+				snapFileName = optarg;
+				break;
+			case 'H': // Percent of each process's regions mapped with huge pages
+				hugePercent = atoi(optarg);
+				if (hugePercent < 0 || hugePercent > 100) {
+					printf("Error: huge page percent must be between 0 and 100. \n");
+					exit(1);
+				}
+				break;
+			case 'z': // Huge page order, huge page is 2^order frames
+				hugeOrder = atoi(optarg);
+				if (hugeOrder < 1 || hugeOrder > MAX_HUGE_ORDER) {
+					printf("Error: huge page order must be between 1 and %d. \n", MAX_HUGE_ORDER);
+					exit(1);
+				}
+				break;
 			case 'h': // Prints out help function.
 				help();
 				return 0;
@@ -99,15 +154,15 @@ int main(int argc, char **argv) {
 	alarm(60);
 	signal(SIGINT, signalHandler);
 	signal(SIGALRM, signalHandler);
+	signal(SIGTERM, signalHandler);
 
-	FILE *file = fopen(logFileName, "w");
-	if (!file) {
-		printf("Error: failed opening log file. \n");
+	// Make sure no other oss is running, then remove shared memory and message queue left behind by a crashed run
+	if (sweepStaleIPC() == -1) {
 		exit(1);
 	}
 
 	// SIMULATED CLOCK
-	int shmid = shmget(SHM_KEY, sizeof(SimulatedClock), IPC_CREAT | 0666); // Creating shared memory using shmget.
+	int shmid = shmget(SHM_KEY, sizeof(SimulatedClock), IPC_CREAT | IPC_EXCL | 0666); // Creating shared memory using shmget.
 	if (shmid == -1) { // If shmid is -1 as a result of shmget failing and returning -1, error message will print.
         	printf("Error: OSS shmget failed. \n");
         	exit(1);
@@ -120,12 +175,33 @@ int main(int argc, char **argv) {
 	}
 
 	// MESSAGE QUEUE
-	int msgid = msgget(MSG_KEY, IPC_CREAT | 0666); // Setting up msg queue.
+	int msgid = msgget(MSG_KEY, IPC_CREAT | IPC_EXCL | 0666); // Setting up msg queue.
         if (msgid == -1) {
                 printf("Error: OSS msgget failed. \n");
                 exit(1);
         }
 
+	// Open output files only once IPC is ours, so a refused start leaves another run's files alone
+	FILE *file = fopen(logFileName, "w");
+	if (!file) {
+		printf("Error: failed opening log file. \n");
+		shmdt(clock);
+		shmctl(shmid, IPC_RMID, NULL);
+		msgctl(msgid, IPC_RMID, NULL);
+		exit(1);
+	}
+
+	if (snapFileName != NULL) {
+		if (snapshotOpen(&snapshot, snapFileName) == -1) {
+			printf("Error: failed opening snapshot file. \n");
+			shmdt(clock);
+			shmctl(shmid, IPC_RMID, NULL);
+			msgctl(msgid, IPC_RMID, NULL);
+			exit(1);
+		}
+		snapshotEnabled = 1;
+	}
+
 	// Initialize clock.
 	clock->seconds = 0;
 	clock->nanoseconds = 0;
@@ -135,6 +211,7 @@ int main(int argc, char **argv) {
 		processTable[i].pid = -1;
 		processTable[i].startSeconds = 0;
 		processTable[i].startNano = 0;
+		processTable[i].hugeRegions = 0;
 		for (int j = 0; j < NUM_PAGES; j++) {
 			processTable[i].pageTable[j] = -1; // -1 = not in memory
 		}
@@ -147,7 +224,11 @@ int main(int argc, char **argv) {
 		frameTable[i].pageNumber = -1;
 		frameTable[i].lastRefSec = 0;
 		frameTable[i].lastRefNano = 0;
+		frameTable[i].pageOrder = 0;
+		frameTable[i].referenced = 0;
+		freeBlockOrder[i] = -1;
 	}
+	freeBlockOrder[0] = BUDDY_TOP_ORDER; // Whole frame table starts as one free block
 
 	// Main Loop
 	while (launched < totalProcesses || activeProcesses > 0) {
@@ -165,52 +246,19 @@ int main(int argc, char **argv) {
 				int isWrite = ioQueue_isWrite[head];
 				int address = ioQueue_address[head];
 
-				// Find a free frame
-				int chosenFrame = -1;
-				for (int i = 0; i < FRAME_COUNT; i++) {
-			    		if (!frameTable[i].occupied) {
-						chosenFrame = i;
-						break;
-			    		}
-				}
+				// Find free frames, a huge region falls back to a base page when memory is fragmented
+				int order = faultOrder(pcbIndex, page);
+				int chosenFrame = allocFrames(&order);
 
 				// If no free frame, use LRU replacement
 				if (chosenFrame == -1) {
-			    		unsigned int oldestSec = 0, oldestNano = 0;
-			    		int firstFound = 1;
-	
-					for (int i = 0; i < FRAME_COUNT; i++) { // Find the oldest frame and evict it.
-						if (firstFound || frameTable[i].lastRefSec < oldestSec || (frameTable[i].lastRefSec == oldestSec && frameTable[i].lastRefNano < oldestNano)) {
-				    			oldestSec = frameTable[i].lastRefSec;
-				    			oldestNano = frameTable[i].lastRefNano;
-				    			chosenFrame = i;
-				    			firstFound = 0;
-						}
-			    		}
- 
-			      		// If dirty, simulate disk write.
-			               if (frameTable[chosenFrame].dirty) {
-			       		       fprintf(file, "OSS: Dirty frame %d being evicted, adding 14ms\n", chosenFrame);
-			   	       }
-
-            			       // Clear old page from previous process.
-            			       int oldPIDIndex = frameTable[chosenFrame].processIndex;
-			   	       int oldPage = frameTable[chosenFrame].pageNumber;
-			   	       if (oldPIDIndex != -1 && oldPage != -1) {
-			       		       processTable[oldPIDIndex].pageTable[oldPage] = -1;
-			   	       }
+					order = faultOrder(pcbIndex, page);
+					evictLRU(order, file); // Evicts or splits whole huge pages, logs dirty frames
+					chosenFrame = buddyAlloc(order);
 				}
 
-				// Load page into chosen frame
-				frameTable[chosenFrame].occupied = 1;
-				frameTable[chosenFrame].dirty = isWrite;
-				frameTable[chosenFrame].lastRefSec = clock->seconds;
-				frameTable[chosenFrame].lastRefNano = clock->nanoseconds;
-				frameTable[chosenFrame].processIndex = pcbIndex;
-			 	frameTable[chosenFrame].pageNumber = page;
-
-				// Update page table for this process
-				processTable[pcbIndex].pageTable[page] = chosenFrame;
+				// Load page into chosen frames and update page table for this process
+				loadPage(pcbIndex, page, order, chosenFrame, isWrite, clock, file);
 				blocked[pcbIndex] = 0;
 
 				// Send reply message back to user
@@ -235,6 +283,22 @@ int main(int argc, char **argv) {
 			fprintf(file, "OSS: Real-time limit of 5 seconds reached. Terminating simulation.\n");
 		    	break;
 		}
+
+		if (shutdownSignal) { // Signal caught, leave the loop and tear down
+			if (shutdownSignal == SIGALRM) { // 60 seconds have passed
+				fprintf(stderr, "Alarm signal caught, terminating all processes.\n");
+				fprintf(file, "OSS: Alarm signal caught, terminating all processes.\n");
+			}
+			else if (shutdownSignal == SIGINT) { // Ctrl-C caught
+				fprintf(stderr, "Ctrl-C signal caught, terminating all processes.\n");
+				fprintf(file, "OSS: Ctrl-C signal caught, terminating all processes.\n");
+			}
+			else { // Killed by another process
+				fprintf(stderr, "Terminate signal caught, terminating all processes.\n");
+				fprintf(file, "OSS: Terminate signal caught, terminating all processes.\n");
+			}
+			break;
+		}
 		
 		// Status of process
 		int status;
@@ -248,15 +312,10 @@ int main(int argc, char **argv) {
 					fprintf(file, "OSS: Process %d terminated at time %u:%u\n", pid, clock->seconds, clock->nanoseconds);
 					
 					activeProcesses--;
-					// Free frames associated with process.
+					// Free frames associated with process, a huge page is released as one block.
 					for (int f = 0; f < FRAME_COUNT; f++) {
 					    	if (frameTable[f].occupied && frameTable[f].processIndex == i) {
-							frameTable[f].occupied = 0;
-							frameTable[f].dirty = 0;
-							frameTable[f].processIndex = -1;
-							frameTable[f].pageNumber = -1;
-							frameTable[f].lastRefSec = 0;
-							frameTable[f].lastRefNano = 0;
+							releaseUnit(f);
 					    	}
 					}
 			    		break;
@@ -276,12 +335,28 @@ int main(int argc, char **argv) {
 			}
 
 			if (pcbIndex != -1) { // Launch child
+				if (activeProcesses == 0) { // Old group is gone once every worker in it was reaped
+					workerGroup = 0;
+				}
+
 				pid_t childPid = fork();
+				if (childPid == -1) { // Leave group and PCB untouched, retry after the next interval
+					perror("OSS: fork failed");
+					fprintf(file, "OSS: fork failed at %u:%u, retrying launch later\n", clock->seconds, clock->nanoseconds);
+					nextLaunchTime = clock->seconds * NANO_TO_SEC + clock->nanoseconds + interval * 1000000;
+					continue;
+				}
 				if (childPid == 0) {
+					setpgid(0, workerGroup); // 0 starts a new group led by this worker
 			    		execl("./worker", "./worker", NULL);
 			    		perror("execl failed");
 			    		exit(1);
 				}
+				// Also set from the parent, whichever runs first wins
+				setpgid(childPid, workerGroup);
+				if (workerGroup == 0) {
+					workerGroup = childPid;
+				}
 				//  Update PCB Table
 				 processTable[pcbIndex].occupied = 1;
 	 			 processTable[pcbIndex].pid = childPid;
@@ -291,6 +366,14 @@ int main(int argc, char **argv) {
 	 			 for (int j = 0; j < NUM_PAGES; j++) {
 	 				 processTable[pcbIndex].pageTable[j] = -1;
 	 			 }
+
+				 // Pick which regions of this process are mapped with huge pages
+				 processTable[pcbIndex].hugeRegions = 0;
+				 for (int r = 0; r < (NUM_PAGES >> hugeOrder); r++) {
+					 if (rand() % 100 < hugePercent) {
+						 processTable[pcbIndex].hugeRegions |= 1u << r;
+					 }
+				 }
 	 
 				 // Update variables
 				  launched++;
@@ -318,7 +401,7 @@ int main(int argc, char **argv) {
 		    	int address = msg.address;
 		    	int isWrite = msg.isWrite;
 			// Convert address to page number
-		    	int page = address / 1024;
+		    	int page = address / PAGE_SIZE;
 
 			// Look up frame number for requested page
 			int frameIndex = processTable[pcbIndex].pageTable[page];	
@@ -330,6 +413,7 @@ int main(int argc, char **argv) {
 				// Update LRU, when it was last accessed.
 				frameTable[frameIndex].lastRefSec = clock->seconds;
 			    	frameTable[frameIndex].lastRefNano = clock->nanoseconds;
+				frameTable[frameIndex].referenced = 1;
 			   
 				if (isWrite) { // Update dirty bit if write operation.
 					frameTable[frameIndex].dirty = 1;
@@ -357,14 +441,12 @@ int main(int argc, char **argv) {
 
 			totalAccesses++;
 			totalPageFaults++;
+			residentFramesSum += residentFrames;
+			mappingUnitsSum += mappingUnits;
+			residentSamples++;
 			
-			int chosenFrame = -1; // Find a free frame
-			for (int i = 0; i < FRAME_COUNT; i++) {
-			    	if (!frameTable[i].occupied) {
-					chosenFrame = i;
-					break;
-			    	}
-			}
+			int order = faultOrder(pcbIndex, page); // Find free frames, huge regions fall back to a base page when fragmented
+			int chosenFrame = allocFrames(&order);
 
 			if (chosenFrame == -1) { // If free frame was not found
 			    	// Calculate fulfill time = now + 14ms
@@ -390,29 +472,9 @@ int main(int argc, char **argv) {
 			    
 				continue; // Skip sending response for now.
 			}
-		    
-			if (frameTable[chosenFrame].dirty) { // Simulate writing
-				fprintf(file, "OSS: Evicting dirty frame %d, adding 14ms I/O delay\n", chosenFrame);       
-			       	incrementClock(clock, 0, 14000000); // 14ms
-		    	}
-
-			// Remove old page from page table.
-		    	int oldPIDIndex = frameTable[chosenFrame].processIndex;
-		    	int oldPage = frameTable[chosenFrame].pageNumber;
-			if (oldPIDIndex != -1 && oldPage != -1) {
-				processTable[oldPIDIndex].pageTable[oldPage] = -1;
-		    	}
 
-			// Load new page into chosen frame
-			frameTable[chosenFrame].occupied = 1;
-			frameTable[chosenFrame].dirty = isWrite;
-			frameTable[chosenFrame].lastRefSec = clock->seconds;
-			frameTable[chosenFrame].lastRefNano = clock->nanoseconds;
-			frameTable[chosenFrame].processIndex = pcbIndex;
-			frameTable[chosenFrame].pageNumber = page;
-
-			// Update this process's page table
-			processTable[pcbIndex].pageTable[page] = chosenFrame;
+			// Load new page into chosen frames and update this process's page table
+			loadPage(pcbIndex, page, order, chosenFrame, isWrite, clock, file);
 
 			// Respond to worker
 			OssMSG response;
@@ -429,28 +491,63 @@ int main(int argc, char **argv) {
 		static unsigned int lastPrintSec = 0;
 		if (clock->seconds > lastPrintSec) { // Indicate when memory layout was printed
 		    	lastPrintSec = clock->seconds; // Update
-		    	fprintf(file, "Memory Layout at %u:%u\n", clock->seconds, clock->nanoseconds);
-		    	printf("Memory Layout at %u:%u\n", clock->seconds, clock->nanoseconds);
-		    
-			for (int i = 0; i < FRAME_COUNT; i++) { // Goes over 256 frames and prints out logs
-				fprintf(file, "Frame %d: %s Dirty=%d LastRef=%u:%u\n", i, frameTable[i].occupied ? "Occupied" : "Empty", frameTable[i].dirty, frameTable[i].lastRefSec, frameTable[i].lastRefNano);
-				printf("Frame %d: %s Dirty=%d LastRef=%u:%u\n", i, frameTable[i].occupied ? "Occupied" : "Empty", frameTable[i].dirty, frameTable[i].lastRefSec, frameTable[i].lastRefNano);
+
+			if (snapshotEnabled) { // Append only what changed since the last snapshot
+				if (snapshotWrite(&snapshot, processTable, frameTable, clock->seconds, clock->nanoseconds) == -1) {
+					printf("Error: failed writing snapshot, snapshots disabled. \n");
+					snapshotClose(&snapshot);
+					snapshotEnabled = 0;
+				}
 			}
+			else { // Text dump of every frame and page table
+			    	fprintf(file, "Memory Layout at %u:%u\n", clock->seconds, clock->nanoseconds);
+			    	printf("Memory Layout at %u:%u\n", clock->seconds, clock->nanoseconds);
+		    
+				for (int i = 0; i < FRAME_COUNT; i++) { // Goes over 256 frames and prints out logs
+					fprintf(file, "Frame %d: %s Dirty=%d Order=%d LastRef=%u:%u\n", i, frameTable[i].occupied ? "Occupied" : "Empty", frameTable[i].dirty, frameTable[i].pageOrder, frameTable[i].lastRefSec, frameTable[i].lastRefNano);
+					printf("Frame %d: %s Dirty=%d Order=%d LastRef=%u:%u\n", i, frameTable[i].occupied ? "Occupied" : "Empty", frameTable[i].dirty, frameTable[i].pageOrder, frameTable[i].lastRefSec, frameTable[i].lastRefNano);
+				}
 		   
-			for (int i = 0; i < MAX_PCB; i++) { // Prints out PCB process
-				if (processTable[i].occupied) {
-			    		fprintf(file, "P%d Page Table: [", processTable[i].pid);
-					printf("P%d Page Table: [", processTable[i].pid);
-					for (int j = 0; j < NUM_PAGES; j++) {
-						fprintf(file, "%d ", processTable[i].pageTable[j]);
-						printf("%d ", processTable[i].pageTable[j]);
-
-			    		}
-			    		fprintf(file, "]\n");
-					printf("]\n");
+				for (int i = 0; i < MAX_PCB; i++) { // Prints out PCB process
+					if (processTable[i].occupied) {
+				    		fprintf(file, "P%d Page Table: [", processTable[i].pid);
+						printf("P%d Page Table: [", processTable[i].pid);
+						for (int j = 0; j < NUM_PAGES; j++) {
+							fprintf(file, "%d ", processTable[i].pageTable[j]);
+							printf("%d ", processTable[i].pageTable[j]);
+
+				    		}
+				    		fprintf(file, "]\n");
+						printf("]\n");
+					}
+			    	}
+			}
+		}
+	}
+
+	// Stop any remaining workers and reap them all before cleaning up
+	alarm(0);
+	if (activeProcesses > 0) {
+		int reaped = teardownWorkers(workerGroup);
+		for (int i = 0; i < MAX_PCB; i++) { // Free frames of every reaped process, same as the waitpid path
+			if (!processTable[i].occupied) {
+				continue;
+			}
+			for (int f = 0; f < FRAME_COUNT; f++) {
+				if (frameTable[f].occupied && frameTable[f].processIndex == i) {
+					releaseUnit(f);
 				}
-		    	}
+			}
+			processTable[i].occupied = 0;
 		}
+		activeProcesses = 0;
+		printf("OSS: Reaped %d remaining processes at %u:%u\n", reaped, clock->seconds, clock->nanoseconds);
+		fprintf(file, "OSS: Reaped %d remaining processes at %u:%u\n", reaped, clock->seconds, clock->nanoseconds);
+	}
+
+	if (snapshotEnabled) { // Record the final layout
+		snapshotWrite(&snapshot, processTable, frameTable, clock->seconds, clock->nanoseconds);
+		snapshotClose(&snapshot);
 	}
 
 	double elapsedSimulatedTime = clock->seconds + (clock->nanoseconds / 1000000000);
@@ -467,6 +564,32 @@ int main(int argc, char **argv) {
         printf("Memory Accesses per Simulated Second: %.2f\n", accessRate);
         printf("Page Fault Rate: %.4f\n", faultRate);
 
+	// Huge page savings against the frames they waste and the TLB entries they save. Averages are sampled on every page fault.
+	// The frame table and page tables keep one entry per frame, so huge pages save mappings, not table entries.
+	for (int i = 0; i < FRAME_COUNT; i++) { // Count still resident huge frames that were never accessed
+		if (frameTable[i].occupied && frameTable[i].pageOrder > 0 && !frameTable[i].referenced) {
+			hugeFramesUntouched++;
+		}
+	}
+	unsigned long long faultsAvoided = hugeFramesLoaded - hugeFaults - hugeFramesUntouched; // Pages that would each have faulted with base pages
+	double avgResident = (residentSamples > 0) ? (double)residentFramesSum / residentSamples : 0;
+	double avgMappings = (residentSamples > 0) ? (double)mappingUnitsSum / residentSamples : 0;
+	double wasteRate = (hugeFramesLoaded > 0) ? (double)hugeFramesUntouched / hugeFramesLoaded : 0;
+	fprintf(file, "\n==== Huge Page Statistics (%dK pages, %d%% of regions) ====\n", (1 << hugeOrder) * PAGE_SIZE / 1024, hugePercent);
+	fprintf(file, "Huge Page Faults: %llu (%llu frames loaded, %llu fell back to base pages)\n", hugeFaults, hugeFramesLoaded, hugeFallbacks);
+	fprintf(file, "Base Page Faults Avoided: %llu\n", faultsAvoided);
+	fprintf(file, "Huge Frames Never Accessed: %llu (%.4f of huge frames)\n", hugeFramesUntouched, wasteRate);
+	fprintf(file, "Huge Pages Evicted: %llu, Split: %llu\n", hugeEvictions, hugeSplits);
+	fprintf(file, "Average TLB Entries for Resident Set: %.2f (%.2f with base pages only, %llu samples)\n", avgMappings, avgResident, residentSamples);
+	fprintf(file, "Frame/Page Table Entries: %.2f kept for %.2f mappings, huge pages still use one entry per frame\n", avgResident, avgMappings);
+	printf("\n==== Huge Page Statistics (%dK pages, %d%% of regions) ====\n", (1 << hugeOrder) * PAGE_SIZE / 1024, hugePercent);
+	printf("Huge Page Faults: %llu (%llu frames loaded, %llu fell back to base pages)\n", hugeFaults, hugeFramesLoaded, hugeFallbacks);
+	printf("Base Page Faults Avoided: %llu\n", faultsAvoided);
+	printf("Huge Frames Never Accessed: %llu (%.4f of huge frames)\n", hugeFramesUntouched, wasteRate);
+	printf("Huge Pages Evicted: %llu, Split: %llu\n", hugeEvictions, hugeSplits);
+	printf("Average TLB Entries for Resident Set: %.2f (%.2f with base pages only, %llu samples)\n", avgMappings, avgResident, residentSamples);
+	printf("Frame/Page Table Entries: %.2f kept for %.2f mappings, huge pages still use one entry per frame\n", avgResident, avgMappings);
+
 	// Detach shared memory
     	if (shmdt(clock) == -1) {
         	printf("Error: OSS Shared memory detachment failed \n");
@@ -487,6 +610,9 @@ int main(int argc, char **argv) {
 
 	fclose(file);
 
+	if (shutdownSignal) { // Interrupted runs exit like the shell reports a signal, so scripts can tell them apart
+		return 128 + shutdownSignal;
+	}
 	return 0;
 }
 
@@ -500,60 +626,270 @@ void incrementClock(SimulatedClock *clock, int addSec, int addNano) { // This fu
     }
 }
 
+int buddyAlloc(int order) { // Returns first frame of a free block of 2^order frames, or -1
+	int found = -1;
+	int foundOrder = order;
 
-void signalHandler(int sig) { // Signal handler
-       	// Catching signal
-	if (sig == SIGALRM) { // 60 seconds have passed
-	       	fprintf(stderr, "Alarm signal caught, terminating all processes.\n");
-       	}
-     	else if (sig == SIGINT) { // Ctrl-C caught
-	       	fprintf(stderr, "Ctrl-C signal caught, terminating all processes.\n");
-       	}
-
-	for (int i = 0; i < MAX_PCB; i++) { // Kill all processes.
-		if (processTable[i].occupied) {
-			kill(processTable[i].pid, SIGTERM);
-	    	}
-	}
-
-	// Cleanup shared memory
-    	int shmid = shmget(SHM_KEY, sizeof(SimulatedClock), 0666);
-    	if (shmid != -1) {
-		SimulatedClock *clock = (SimulatedClock *)shmat(shmid, NULL, 0);
-		if (clock != (void *)-1) { // Detach shared memory
-			if (shmdt(clock) == -1) {
-				printf("Error: OSS Shared memory detachment failed \n");
-				exit(1);
+	for (int o = order; o <= BUDDY_TOP_ORDER && found == -1; o++) { // Smallest free block that fits
+		for (int f = 0; f < FRAME_COUNT; f += 1 << o) {
+			if (freeBlockOrder[f] == o) {
+				found = f;
+				foundOrder = o;
+				break;
 			}
 		}
-		// Remove shared memory
+	}
+	if (found == -1) {
+		return -1;
+	}
+
+	freeBlockOrder[found] = -1;
+	while (foundOrder > order) { // Split down, upper halves go back as free blocks
+		foundOrder--;
+		freeBlockOrder[found + (1 << foundOrder)] = foundOrder;
+	}
+	return found;
+}
+
+void buddyFree(int frame, int order) { // Return a block and merge it with its free buddies
+	while (order < BUDDY_TOP_ORDER) {
+		int buddy = frame ^ (1 << order);
+		if (freeBlockOrder[buddy] != order) {
+			break;
+		}
+		freeBlockOrder[buddy] = -1;
+		frame &= ~(1 << order);
+		order++;
+	}
+	freeBlockOrder[frame] = order;
+}
+
+int faultOrder(int pcbIndex, int page) { // Order to fault page in with, huge only if none of its region is resident
+	int region = page >> hugeOrder;
+	if (!(processTable[pcbIndex].hugeRegions & (1u << region))) {
+		return 0;
+	}
+
+	int firstPage = region << hugeOrder;
+	for (int j = firstPage; j < firstPage + (1 << hugeOrder); j++) {
+		if (processTable[pcbIndex].pageTable[j] != -1) { // Region was split, fault base pages back in
+			return 0;
+		}
+	}
+	return hugeOrder;
+}
+
+int allocFrames(int *order) { // Free frames for a fault, falls back to one base frame if no huge block is free
+	int frame = buddyAlloc(*order);
+	if (frame == -1 && *order > 0) {
+		frame = buddyAlloc(0);
+		if (frame != -1) {
+			*order = 0;
+			hugeFallbacks++;
+		}
+	}
+	return frame;
+}
+
+void loadPage(int pcbIndex, int page, int order, int frame, int isWrite, SimulatedClock *clock, FILE *file) { // Map page, or its whole region if huge, into frames starting at frame
+	int firstPage = page & ~((1 << order) - 1);
+
+	for (int k = 0; k < (1 << order); k++) {
+		int f = frame + k;
+		frameTable[f].occupied = 1;
+		frameTable[f].dirty = (firstPage + k == page) ? isWrite : 0;
+		frameTable[f].lastRefSec = clock->seconds;
+		frameTable[f].lastRefNano = clock->nanoseconds;
+		frameTable[f].processIndex = pcbIndex;
+		frameTable[f].pageNumber = firstPage + k;
+		frameTable[f].pageOrder = order;
+		frameTable[f].referenced = (firstPage + k == page);
+		processTable[pcbIndex].pageTable[firstPage + k] = f;
+	}
+	residentFrames += 1 << order;
+	mappingUnits++;
+
+	if (order > 0) {
+		hugeFaults++;
+		hugeFramesLoaded += 1 << order;
+		fprintf(file, "OSS: Mapped pages %d-%d of P%d as a huge page in frames %d-%d\n", firstPage, firstPage + (1 << order) - 1, processTable[pcbIndex].pid, frame, frame + (1 << order) - 1);
+	}
+}
+
+void releaseUnit(int frame) { // Unmap the page holding frame, a huge page is released as one block
+	int order = frameTable[frame].pageOrder;
+	int head = frame & ~((1 << order) - 1);
+
+	for (int f = head; f < head + (1 << order); f++) {
+		int oldPIDIndex = frameTable[f].processIndex;
+		int oldPage = frameTable[f].pageNumber;
+		if (oldPIDIndex != -1 && oldPage != -1) {
+			processTable[oldPIDIndex].pageTable[oldPage] = -1;
+		}
+		if (order > 0 && !frameTable[f].referenced) {
+			hugeFramesUntouched++;
+		}
+
+		frameTable[f].occupied = 0;
+		frameTable[f].dirty = 0;
+		frameTable[f].processIndex = -1;
+		frameTable[f].pageNumber = -1;
+		frameTable[f].lastRefSec = 0;
+		frameTable[f].lastRefNano = 0;
+		frameTable[f].pageOrder = 0;
+		frameTable[f].referenced = 0;
+	}
+	buddyFree(head, order);
+	residentFrames -= 1 << order;
+	mappingUnits--;
+}
+
+void evictLRU(int order, FILE *file) { // Free an aligned block of 2^order frames using LRU
+	unsigned int oldestSec = 0, oldestNano = 0;
+	int firstFound = 1;
+	int chosenBlock = -1;
+
+	for (int b = 0; b < FRAME_COUNT; b += 1 << order) { // Block whose most recent reference is the oldest
+		unsigned int newestSec = 0, newestNano = 0;
+		for (int f = b; f < b + (1 << order); f++) {
+			if (frameTable[f].occupied && (frameTable[f].lastRefSec > newestSec || (frameTable[f].lastRefSec == newestSec && frameTable[f].lastRefNano > newestNano))) {
+				newestSec = frameTable[f].lastRefSec;
+				newestNano = frameTable[f].lastRefNano;
+			}
+		}
+		if (firstFound || newestSec < oldestSec || (newestSec == oldestSec && newestNano < oldestNano)) {
+			oldestSec = newestSec;
+			oldestNano = newestNano;
+			chosenBlock = b;
+			firstFound = 0;
+		}
+	}
+
+	if (order == 0 && frameTable[chosenBlock].pageOrder > 0) { // Split the huge page so only this frame is evicted
+		int splitOrder = frameTable[chosenBlock].pageOrder;
+		int head = chosenBlock & ~((1 << splitOrder) - 1);
+		for (int f = head; f < head + (1 << splitOrder); f++) {
+			frameTable[f].pageOrder = 0;
+			if (!frameTable[f].referenced) { // Loaded by the huge fault but never used
+				hugeFramesUntouched++;
+				frameTable[f].referenced = 1;
+			}
+		}
+		hugeSplits++;
+		mappingUnits += (1 << splitOrder) - 1; // One mapping becomes one per frame
+		fprintf(file, "OSS: Split huge page in frames %d-%d to evict frame %d\n", head, head + (1 << splitOrder) - 1, chosenBlock);
+	}
+
+	for (int f = chosenBlock; f < chosenBlock + (1 << order); f++) {
+		if (!frameTable[f].occupied) {
+			continue;
+		}
+		if (frameTable[f].dirty) { // If dirty, simulate disk write.
+			fprintf(file, "OSS: Dirty frame %d being evicted, adding 14ms\n", f);
+		}
+		if (frameTable[f].pageOrder > 0) {
+			hugeEvictions++;
+		}
+		releaseUnit(f); // Clears every frame of a huge page, so the loop skips the rest of it
+	}
+}
+
+
+int sweepStaleIPC() { // Take the oss lock, then remove IPC objects a crashed run left on our keys. Returns -1 if another oss holds the lock
+	// The kernel drops the lock when its holder exits however it exits, so unlike a pid it cannot go stale.
+	// O_CLOEXEC keeps workers from inheriting it, an orphaned worker must not keep a dead run's lock alive.
+	int lockFd = open(LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+	if (lockFd == -1) {
+		printf("Error: failed opening lock file %s. \n", LOCK_FILE);
+		return -1;
+	}
+	if (flock(lockFd, LOCK_EX | LOCK_NB) == -1) {
+		if (errno == EWOULDBLOCK) {
+			printf("Error: another oss is running and owns the shared memory and msg queue. \n");
+		}
+		else {
+			printf("Error: failed locking %s. \n", LOCK_FILE);
+		}
+		close(lockFd);
+		return -1;
+	}
+	// lockFd stays open for the rest of the run to hold the lock
+
+	// With the lock held, anything on our keys belongs to a run that is gone
+	int shmid = shmget(SHM_KEY, 0, 0666);
+	if (shmid != -1) {
 		if (shmctl(shmid, IPC_RMID, NULL) == -1) {
-                	printf("Error: Removing memory failed \n");
-                	exit(1);
-        	}
+			printf("Error: Removing stale shared memory failed \n");
+			return -1;
+		}
+		printf("OSS: Removed stale shared memory from a previous run.\n");
 	}
 
-	// Cleanup message queue
-    	int msgid = msgget(MSG_KEY, 0666);
-    	if (msgid != -1) {
+	// Removing the queue also wakes any orphaned workers blocked in msgrcv, which then exit
+	int msgid = msgget(MSG_KEY, 0666);
+	if (msgid != -1) {
 		if (msgctl(msgid, IPC_RMID, NULL) == -1) {
-		    	printf("Error: Removing msg queue failed. \n");
-		       	exit(1);
-	       	}
-       	}
+			printf("Error: Removing stale msg queue failed. \n");
+			return -1;
+		}
+		printf("OSS: Removed stale msg queue from a previous run.\n");
+	}
+	return 0;
+}
+
+int teardownWorkers(pid_t workerGroup) { // Stop every worker and reap it, returns how many were reaped
+	int reaped = 0;
+
+	if (workerGroup > 0 && kill(-workerGroup, SIGTERM) == -1 && errno != ESRCH) {
+		perror("OSS: kill SIGTERM failed");
+	}
 
+	// Drain, reap workers as they exit until none are left or the deadline passes
+	struct timespec start, now;
+	struct timespec pause = {0, 1000000}; // 1ms between polls
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (1) {
+		pid_t pid = waitpid(-1, NULL, WNOHANG);
+		if (pid > 0) {
+			reaped++;
+			continue;
+		}
+		if (pid == -1) { // No children left
+			return reaped;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long elapsedMs = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+		if (elapsedMs >= DRAIN_TIMEOUT_MS) {
+			break;
+		}
+		nanosleep(&pause, NULL);
+	}
 
+	// Deadline passed, kill the rest of the group and reap everything still left
+	if (workerGroup > 0 && kill(-workerGroup, SIGKILL) == -1 && errno != ESRCH) {
+		perror("OSS: kill SIGKILL failed");
+	}
+	while (waitpid(-1, NULL, 0) > 0) {
+		reaped++;
+	}
+	return reaped;
+}
 
-	exit(1);
+void signalHandler(int sig) { // Signal handler, only records the signal, main loop does the teardown
+	shutdownSignal = sig;
 }
 
 void help() {
-	printf("Usage: ./oss [-h] [-n proc] [-s simul] [-i interval] [-f logfile] [-v]\n");
+	printf("Usage: ./oss [-h] [-n proc] [-s simul] [-i interval] [-f logfile] [-m snapfile] [-H percent] [-z order] [-v]\n");
     	printf("Options:\n");
     	printf("-h 	      Show this help message and exit.\n");
     	printf("-n proc       Total number of user processes to launch (default: 40).\n");
     	printf("-s simul      Maximum number of simultaneous processes (max: 18).\n");
     	printf("-i interval   Time interval (ms) between process launches (default: 500).\n");
 	printf("-f logfile    Name of the log file to write output (default: oss.log).\n");
+	printf("-m snapfile   Write binary memory map snapshots to snapfile instead of printing them, read with ./memview.\n");
+	printf("-H percent    Percent of each process's regions mapped with huge pages (default: 0).\n");
+	printf("-z order      Huge page size as 2^order 1K frames, 1 to %d (default: %d, 8K).\n", MAX_HUGE_ORDER, DEFAULT_HUGE_ORDER);
 }
 
@@ -8,11 +8,14 @@
 
 #define SHM_KEY 856050
 #define MSG_KEY 875010
+#define LOCK_FILE "/tmp/oss_856050.lock" // flock held by the running oss, guards SHM_KEY and MSG_KEY
 #define MAX_PCB 20
 #define MAX_PROCESSES 18
 #define NUM_PAGES 32            // 32K per process with 1K pages
 #define FRAME_COUNT 256         // Total frames in system
 #define PAGE_SIZE 1024          // 1K per page
+#define MAX_HUGE_ORDER 5        // Largest huge page is 2^5 frames (32K)
+#define DEFAULT_HUGE_ORDER 3    // Huge pages are 2^3 frames (8K) unless -z is given
 
 // Author: Dat Nguyen
 // oss.h is a header file that holds our structures and constant definitions for memory management and paging
@@ -30,6 +33,7 @@ typedef struct PCB {
     int startSeconds;
     int startNano;
     int pageTable[NUM_PAGES];  // Each index maps to a frame number or -1 if not present
+    unsigned int hugeRegions;  // Bit r set = pages of region r (2^order pages each) are faulted in as one huge page
 } PCB;
 
 // Frame Table Entry
@@ -38,6 +42,8 @@ typedef struct FrameTableEntry {
     int dirty;                 // 1 = modified (write), 0 = clean
     int processIndex;          // Index of process using it
     int pageNumber;            // Page number within that process
+    int pageOrder;             // 0 = base page, otherwise part of a 2^order frame huge page
+    int referenced;            // 1 once the page was accessed since it was loaded
     unsigned int lastRefSec;   // Last reference time (seconds)
     unsigned int lastRefNano;  // Last reference time (nanoseconds)
 } FrameTableEntry;
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "snapshot.h"
+
+// Author: Dat Nguyen
+// snapshot.c writes memory map snapshots as binary records into a memory-mapped file. Only frames and PCBs that changed since
+// the previous snapshot are written, with a full keyframe every SNAPSHOT_KEYFRAME_INTERVAL snapshots.
+
+// Largest possible record, a keyframe
+#define SNAPSHOT_MAX_RECORD (sizeof(SnapshotRecord) + FRAME_COUNT * sizeof(SnapshotFrame) + MAX_PCB * sizeof(SnapshotPCB))
+
+static int snapshotMap(SnapshotWriter *writer, size_t size) { // Grow file to size and map all of it, the old mapping stays valid on failure
+	if (ftruncate(writer->fd, size) == -1) {
+		return -1;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+
+	if (writer->map != NULL) {
+		munmap(writer->map, writer->mapSize);
+	}
+	writer->map = (char *)map;
+	writer->mapSize = size;
+	return 0;
+}
+
+int snapshotOpen(SnapshotWriter *writer, const char *fileName) {
+	memset(writer, 0, sizeof(SnapshotWriter));
+
+	writer->fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (writer->fd == -1) {
+		return -1;
+	}
+
+	if (snapshotMap(writer, SNAPSHOT_GROW_SIZE) == -1) {
+		close(writer->fd);
+		writer->fd = -1;
+		return -1;
+	}
+
+	SnapshotHeader *header = (SnapshotHeader *)writer->map;
+	header->magic = SNAPSHOT_MAGIC;
+	header->version = SNAPSHOT_VERSION;
+	header->frameCount = FRAME_COUNT;
+	header->maxPcb = MAX_PCB;
+	header->numPages = NUM_PAGES;
+	header->keyframeInterval = SNAPSHOT_KEYFRAME_INTERVAL;
+	header->length = 0;
+	return 0;
+}
+
+int snapshotWrite(SnapshotWriter *writer, const PCB *processTable, const FrameTableEntry *frameTable, unsigned int seconds, unsigned int nanoseconds) {
+	SnapshotHeader *header = (SnapshotHeader *)writer->map;
+	size_t offset = sizeof(SnapshotHeader) + header->length;
+
+	if (offset + SNAPSHOT_MAX_RECORD > writer->mapSize) { // Make room for a worst case record
+		if (snapshotMap(writer, writer->mapSize + SNAPSHOT_GROW_SIZE) == -1) {
+			return -1;
+		}
+		header = (SnapshotHeader *)writer->map;
+	}
+
+	int keyframe = (writer->snapshotCount % SNAPSHOT_KEYFRAME_INTERVAL) == 0;
+	SnapshotRecord *record = (SnapshotRecord *)(writer->map + offset);
+	char *cursor = writer->map + offset + sizeof(SnapshotRecord);
+
+	record->type = keyframe ? SNAPSHOT_KEYFRAME : SNAPSHOT_DELTA;
+	record->seconds = seconds;
+	record->nanoseconds = nanoseconds;
+	record->frameChanges = 0;
+	record->pcbChanges = 0;
+
+	for (int i = 0; i < FRAME_COUNT; i++) { // Frames that changed since last snapshot
+		if (keyframe || memcmp(&frameTable[i], &writer->lastFrames[i], sizeof(FrameTableEntry)) != 0) {
+			SnapshotFrame *frame = (SnapshotFrame *)cursor;
+			frame->frameIndex = i;
+			frame->entry = frameTable[i];
+			writer->lastFrames[i] = frameTable[i];
+			cursor += sizeof(SnapshotFrame);
+			record->frameChanges++;
+		}
+	}
+
+	for (int i = 0; i < MAX_PCB; i++) { // PCB slots that changed since last snapshot
+		pid_t pid = processTable[i].occupied ? processTable[i].pid : -1;
+		if (keyframe || writer->lastPCB[i].occupied != processTable[i].occupied || writer->lastPCB[i].pid != pid) {
+			SnapshotPCB *pcb = (SnapshotPCB *)cursor;
+			pcb->pcbIndex = i;
+			pcb->occupied = processTable[i].occupied;
+			pcb->pid = pid;
+			writer->lastPCB[i] = *pcb;
+			cursor += sizeof(SnapshotPCB);
+			record->pcbChanges++;
+		}
+	}
+
+	// Publish the record only once it is complete
+	header->length += cursor - (writer->map + offset);
+	writer->snapshotCount++;
+	return 0;
+}
+
+void snapshotClose(SnapshotWriter *writer) {
+	if (writer->fd == -1) {
+		return;
+	}
+
+	// Valid length comes from the mapped header, or from the file if nothing is mapped
+	SnapshotHeader header;
+	if (writer->map != NULL) {
+		header = *(SnapshotHeader *)writer->map;
+		munmap(writer->map, writer->mapSize);
+		writer->map = NULL;
+	}
+	else if (pread(writer->fd, &header, sizeof(SnapshotHeader), 0) != sizeof(SnapshotHeader)) {
+		header.length = 0;
+	}
+	size_t used = sizeof(SnapshotHeader) + header.length;
+
+	// Trim the unused tail left over from growing
+	if (ftruncate(writer->fd, used) == -1) {
+		perror("snapshot: ftruncate failed");
+	}
+	close(writer->fd);
+	writer->fd = -1;
+}
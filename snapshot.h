@@ -0,0 +1,65 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include "oss.h"
+
+#define SNAPSHOT_MAGIC 0x4d4d4150     // "MMAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_KEYFRAME_INTERVAL 10 // Full keyframe every 10 snapshots
+#define SNAPSHOT_GROW_SIZE (1 << 20)  // Grow the mapped file 1MB at a time
+
+#define SNAPSHOT_DELTA 0              // Record holds only frames/PCBs that changed
+#define SNAPSHOT_KEYFRAME 1           // Record holds every frame and PCB
+
+// Author: Dat Nguyen
+// snapshot.h holds the binary layout of the memory map snapshot file written by oss -m and read back by memview.
+
+// File header, stored at offset 0
+typedef struct SnapshotHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int frameCount;
+    unsigned int maxPcb;
+    unsigned int numPages;
+    unsigned int keyframeInterval;
+    unsigned long long length;  // Bytes of complete records after the header, updated after every record
+} SnapshotHeader;
+
+// Record header, followed by frameChanges SnapshotFrame entries and then pcbChanges SnapshotPCB entries
+typedef struct SnapshotRecord {
+    unsigned int type;          // SNAPSHOT_DELTA or SNAPSHOT_KEYFRAME
+    unsigned int seconds;       // Simulated time of the snapshot
+    unsigned int nanoseconds;
+    unsigned int frameChanges;
+    unsigned int pcbChanges;
+} SnapshotRecord;
+
+// Frame table entry as of the snapshot
+typedef struct SnapshotFrame {
+    int frameIndex;
+    FrameTableEntry entry;
+} SnapshotFrame;
+
+// PCB slot as of the snapshot, page tables are rebuilt from the frame table
+typedef struct SnapshotPCB {
+    int pcbIndex;
+    int occupied;
+    pid_t pid;
+} SnapshotPCB;
+
+// Writer state kept by oss
+typedef struct SnapshotWriter {
+    int fd;
+    char *map;                  // Mapping of the whole file
+    size_t mapSize;
+    unsigned int snapshotCount;
+    FrameTableEntry lastFrames[FRAME_COUNT]; // State as of the previous snapshot
+    SnapshotPCB lastPCB[MAX_PCB];
+} SnapshotWriter;
+
+int snapshotOpen(SnapshotWriter *writer, const char *fileName); // Returns -1 on failure
+int snapshotWrite(SnapshotWriter *writer, const PCB *processTable, const FrameTableEntry *frameTable, unsigned int seconds, unsigned int nanoseconds); // Returns -1 on failure
+void snapshotClose(SnapshotWriter *writer);
+
+#endif